@@ -0,0 +1,122 @@
+/*--------------------------------------------------------------------------------------
+ CONFIG.C - The file that contains the configuration block handling.
+ Copyright (C) 2020 Jagannatha Rao (aka JagiChan) (jagannath_raous@yahoo.com)
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------------------------*/
+
+#include "rgbmain.h"
+#include "usart.h"
+#include "eeprom.h"
+#include "sound.h"
+#include "config.h"
+
+//eeprom addresses of the color (0~100 duty cycles) stored by the older software. Only read while
+//no valid block was ever written, the first ConfigSave() moves the color and clears addresses 0~3.
+#define LEGACY_RED_ADDR     0
+#define LEGACY_GRN_ADDR     1
+#define LEGACY_BLU_ADDR     2
+#define LEGACY_LEN          4
+
+#define CONFIG_CRC_LEN      (sizeof (config) - 1)	//the crc itself is not included
+
+struct Config config;
+
+// CRC-8 (polynomial x^8 + x^2 + x + 1) of the configuration, starts at 0xFF so that an all zero block is invalid
+unsigned char ConfigCRC(void)
+{
+    unsigned char *ptr = (unsigned char *) &config;
+    unsigned char crc = 0xFF;
+
+    for (unsigned char i = CONFIG_CRC_LEN; i > 0; i--)
+    {
+        crc ^= *ptr++;
+        for (unsigned char bitCnt = 8; bitCnt > 0; bitCnt--)
+        {
+            if (crc & 0x80)
+                crc = (crc << 1) ^ 0x07;
+            else
+                crc <<= 1;
+        }
+    }
+
+    return crc;
+}
+
+// Read the configuration block, the defaults (and the color of the older software) are used if it is not valid
+void ConfigLoad(void)
+{
+    EEreadBlock(CONFIG_ADDR, (unsigned char *) &config, sizeof (config));
+
+    if ((config.version == CONFIG_VERSION) && (config.crc == ConfigCRC()))
+        return;
+
+    ConfigDefaults();
+
+    //a color of the older software, it used an all zero color for no user color
+    config.red = EEread(LEGACY_RED_ADDR);
+    config.green = EEread(LEGACY_GRN_ADDR);
+    config.blue = EEread(LEGACY_BLU_ADDR);
+    if ((config.red <= 100) && (config.green <= 100) && (config.blue <= 100) &&
+        ((config.red != 0) || (config.green != 0) || (config.blue != 0)))
+    {
+        config.red = LED_PCT_TO_COLOR(config.red);
+        config.green = LED_PCT_TO_COLOR(config.green);
+        config.blue = LED_PCT_TO_COLOR(config.blue);
+        config.flags |= CFG_USER_COLOR;
+    }
+    else
+    {
+        config.red = 0;
+        config.green = 0;
+        config.blue = 0;
+    }
+}
+
+// Set the default configuration: no user color, 9600 baud, sound off
+void ConfigDefaults(void)
+{
+    config.version = CONFIG_VERSION;
+    config.flags = 0;
+    config.red = 0;
+    config.green = 0;
+    config.blue = 0;
+    config.baud = USART_DEF_BAUD;
+    config.soundMode = SOUND_OFF;
+    config.soundThreshold = SOUND_DEF_THRESHOLD;
+    config.fadeTime = 0;
+    config.address = 0;
+    config.brightness = 100;
+    config.crc = ConfigCRC();
+}
+
+// Write the configuration block, only the bytes that changed are written.
+// The data of the older software is cleared after the block, so it can not come back when the block is lost.
+void ConfigSave(void)
+{
+    unsigned char *ptr = (unsigned char *) &config;
+    unsigned char i;
+
+    config.version = CONFIG_VERSION;
+    config.crc = ConfigCRC();
+
+    for (i = 0; i < sizeof (config); i++)
+    {
+        CLRWDT(); //kick the dog, every write takes a few ms
+        if (EEread(CONFIG_ADDR + i) != ptr[i])
+            EEwrite(CONFIG_ADDR + i, ptr[i]);
+    }
+
+    for (i = 0; i < LEGACY_LEN; i++)
+    {
+        CLRWDT();
+        if (EEread(i) != 0)
+            EEwrite(i, 0);
+    }
+}
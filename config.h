@@ -0,0 +1,49 @@
+/*--------------------------------------------------------------------------------------
+ CONFIG.H - Header file for the configuration stored in the EEPROM.
+ Copyright (C) 2020 Jagannatha Rao (aka JagiChan) (jagannath_raous@yahoo.com)
+
+ All the settings are kept in one block in the EEPROM, protected by a version byte and a
+ CRC-8. The block is read in one sequential pass at power on, if the version or the CRC
+ does not match (new chip, brownout during a write) the defaults are used.
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------------------------*/
+
+#ifndef CONFIG_H
+#define	CONFIG_H
+
+#define CONFIG_ADDR     0x08	//eeprom address of the configuration block
+#define CONFIG_VERSION  1		//change when the layout of struct Config changes
+
+//flags
+#define CFG_USER_COLOR  0x01	//user selected a color, otherwise random colors are shown
+
+struct Config {
+    unsigned char version;
+    unsigned char flags;
+    unsigned char red;			//user color, 0~255 per color
+    unsigned char green;
+    unsigned char blue;
+    unsigned char baud;			//baud rate table index (USART_BAUD_xxx)
+    unsigned char soundMode;	//SOUND_xxx
+    unsigned char soundThreshold;
+    unsigned char fadeTime;		//not used yet
+    unsigned char address;		//not used yet
+    unsigned char brightness;	//not used yet, 0~100
+    unsigned char crc;			//CRC-8 of all the bytes above
+};
+
+extern struct Config config;
+
+void ConfigLoad(void);
+void ConfigDefaults(void);
+void ConfigSave(void);
+
+#endif	/* CONFIG_H */
+
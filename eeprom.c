@@ -13,20 +13,39 @@
 
 #include <xc.h>
 
-#define Nop()   asm("nop")
+#if defined(_PIC14E)
+#define EEADR   EEADRL	//enhanced mid-range parts have a 16 bit address/data register pair
+#define EEDATA  EEDATL
+#endif
 
 // reads a byte from the EEPROM at the given address
 unsigned char EEread(unsigned char addr)
 {
     EEADR = addr;
-    EECON1bits.RD = 1;
-    Nop(); //wait for completion of command
-    Nop(); //maybe useful if the clock frequency is high
-    Nop();
-    Nop();
+#if defined(_PIC14E)
+    EECON1bits.CFGS = 0; //access the data EEPROM, not the configuration or program memory
+    EECON1bits.EEPGD = 0;
+#endif
+    EECON1bits.RD = 1; //the data is available in the next instruction cycle
     return(EEDATA); //return the byte
 }
 
+// reads len bytes starting at the given address in one sequential pass
+void EEreadBlock(unsigned char addr, unsigned char *data, unsigned char len)
+{
+    EEADR = addr;
+#if defined(_PIC14E)
+    EECON1bits.CFGS = 0;
+    EECON1bits.EEPGD = 0;
+#endif
+    while (len--)
+    {
+        EECON1bits.RD = 1;
+        *data++ = EEDATA;
+        EEADR++;
+    }
+}
+
 // writes a byte to the EEPROM at the given address
 void EEwrite(unsigned char addr, unsigned char data)
 {
@@ -34,13 +53,17 @@ void EEwrite(unsigned char addr, unsigned char data)
 
     EEADR = addr;
     EEDATA = data;
+#if defined(_PIC14E)
+    EECON1bits.CFGS = 0;
+    EECON1bits.EEPGD = 0;
+#endif
     EECON1bits.WREN = 1;
     GIE_BIT_VAL = INTCONbits.GIE;
     INTCONbits.GIE = 0;
     EECON2 = 0x55; //critical unlock sequence
     EECON2 = 0xAA;
     EECON1bits.WR = 1; //end critical sequence
+    INTCONbits.GIE = GIE_BIT_VAL; //the PWM keeps running during the write
     while (EECON1bits.WR); //wait for write finish
-    INTCONbits.GIE = GIE_BIT_VAL;
     EECON1bits.WREN = 0;
 }
@@ -16,6 +16,7 @@
 #define	EEPROM_H
 
 unsigned char EEread(unsigned char addr);
+void EEreadBlock(unsigned char addr, unsigned char *data, unsigned char len);
 void EEwrite(unsigned char addr, unsigned char data);
 
 #endif	/* EEPROM_H */
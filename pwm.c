@@ -0,0 +1,573 @@
+/*--------------------------------------------------------------------------------------
+ PWM.C - The file that contains the LED PWM driver backends.
+ Copyright (C) 2020 Jagannatha Rao (aka JagiChan) (jagannath_raous@yahoo.com)
+
+ Temporal dithering
+ ------------------
+ The application sets a level per channel with PWM_FRAC_BITS more resolution than the
+ PWM itself. At the start of every PWM period the fractional part is added to an 8 bit
+ accumulator per channel and the carry out of the accumulator extends the duty cycle of
+ that period by one step (first order sigma-delta). Averaged over a few periods the LED
+ gets the fractional duty cycle, which removes the visible steps at the dark end of slow
+ fades. The update is a byte add and compare per channel, cheap enough to run in the
+ interrupt once per PWM period.
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------------------------*/
+
+#include "pwm.h"
+
+#if PWM_BACKEND != PWM_BACKEND_HOST
+#include <xc.h>
+#endif
+
+unsigned int pwmNextLevel[PWM_CHANNELS];	// levels set by the application, applied on PWMLatch()
+unsigned char pwmAcc[PWM_CHANNELS];			// dithering accumulators
+
+unsigned int pwmBoost;						// added to all the duty cycles, see PWMBoost()
+unsigned int pwmBoostDecay;
+volatile unsigned char pwmPeriods;			// counts the PWM periods
+
+// current value of the boost, the boost drops by the decay for the next period
+#define PWM_BOOST_NEXT(boost)   {boost = pwmBoost; \
+                                 if (pwmBoost > pwmBoostDecay) pwmBoost -= pwmBoostDecay; else pwmBoost = 0;}
+
+#if PWM_BACKEND == PWM_BACKEND_CCP
+
+/*--------------------------------------------------------------------------------------
+ Hardware PWM on the CCP modules. Timer 2 is the time base for all the modules, the
+ duty cycle registers are double buffered by the hardware and take effect at the start
+ of the next PWM period. PWMTick() is called from the Timer 2 interrupt once per period
+ to load the dithered duty cycles. When no channel has a fraction and there is no boost
+ the duty cycles do not change from period to period, so PWMTick() switches the interrupt
+ off until the next change.
+--------------------------------------------------------------------------------------*/
+
+#define CCP_PWM_MODE    0x0C			//CCPxM<3:0> = 11xx, PWM mode, single output
+#define PWM_RESTART_PERIOD()    {if (pwmEnabled) TMR2IE = 1;}	//the interrupt loads the next period
+
+unsigned char pwmEnabled;				// set by PWMEnable()
+volatile unsigned char pwmLatchReq;		// new levels waiting for the start of the next period
+unsigned char pwmDither;				// any fraction set, the interrupt has to run every period
+unsigned int pwmBaseDC[PWM_CHANNELS];	// integer part of the level
+unsigned char pwmFrac[PWM_CHANNELS];	// fractional part of the level, left aligned to 8 bits
+unsigned int pwmDC[PWM_CHANNELS];		// duty cycles of the next period
+
+// add the fraction to the accumulator, the carry gives one extra step in this period
+#define PWM_DITHER(ch)  {pwmAcc[ch] += pwmFrac[ch]; \
+                         pwmDC[ch] = pwmBaseDC[ch] + boost; \
+                         if (pwmAcc[ch] < pwmFrac[ch]) pwmDC[ch]++; \
+                         if (pwmDC[ch] > PWM_MAX_DUTY) pwmDC[ch] = PWM_MAX_DUTY;}
+
+// Initialize Timer 2 and the CCP modules, outputs stay disabled until PWMEnable()
+void PWMInit(void)
+{
+    for (unsigned char i = 0; i < PWM_CHANNELS; i++)
+    {
+        pwmNextLevel[i] = 0;
+        pwmBaseDC[i] = 0;
+        pwmFrac[i] = 0;
+        pwmAcc[i] = 0;
+    }
+    pwmLatchReq = 0;
+    pwmDither = 0;
+    pwmBoost = 0;
+    pwmBoostDecay = 0;
+    pwmEnabled = 0;
+
+    APFCON0bits.CCP1SEL = 1;	//CCP1 on RB0
+    APFCON0bits.CCP2SEL = 1;	//CCP2 on RA7
+    CCPTMRS = 0x00;				//all CCP modules use Timer 2
+
+    PR2 = 0xFF;					//10 bit resolution, 32Mhz/4/4/256 = 7.8Khz PWM
+    T2CON = 0b00000101;			//prescaler 1:4, postscaler 1:1, Timer 2 on
+    TMR2IF = 0;
+    PEIE = 1;
+}
+
+// Connect (enable != 0) or disconnect the CCP modules from the LED pins. Disabled outputs are driven low.
+void PWMEnable(unsigned char enable)
+{
+    pwmEnabled = enable;
+    if (enable)
+    {
+        CCP2CON |= CCP_PWM_MODE;
+        CCP4CON |= CCP_PWM_MODE;
+        CCP1CON |= CCP_PWM_MODE;
+        TMR2IE = 1;
+    }
+    else
+    {
+        TMR2IE = 0;
+        CCP2CON &= ~CCP_PWM_MODE;
+        CCP4CON &= ~CCP_PWM_MODE;
+        CCP1CON &= ~CCP_PWM_MODE;
+        LATAbits.LATA7 = 0;
+        LATAbits.LATA4 = 0;
+        LATBbits.LATB0 = 0;
+    }
+}
+
+// Ask the interrupt to pick up the new levels at the start of the next period
+void PWMLatch(void)
+{
+    pwmLatchReq = 1; //before the interrupt is switched on, so that it can not be switched off again before the levels are loaded
+    PWM_RESTART_PERIOD();
+}
+
+// Load the duty cycles for the next period (10 bits, 8 MSB in CCPRxL and 2 LSB in DCxB)
+void PWMTick(void)
+{
+    unsigned int boost;
+
+    //split the latched levels in the duty cycle and the fraction used for dithering
+    if (pwmLatchReq)
+    {
+        pwmDither = 0;
+        for (unsigned char i = 0; i < PWM_CHANNELS; i++)
+        {
+            pwmBaseDC[i] = pwmNextLevel[i] >> PWM_FRAC_BITS;
+            pwmFrac[i] = (unsigned char) (pwmNextLevel[i] << (8 - PWM_FRAC_BITS));
+            pwmDither |= pwmFrac[i];
+        }
+        pwmLatchReq = 0;
+    }
+
+    PWM_BOOST_NEXT(boost);
+    PWM_DITHER(PWM_CH_RED);
+    PWM_DITHER(PWM_CH_GREEN);
+    PWM_DITHER(PWM_CH_BLUE);
+    pwmPeriods++;
+
+    CCPR2L = (unsigned char) (pwmDC[PWM_CH_RED] >> 2);
+    CCP2CON = (CCP2CON & 0xCF) | ((pwmDC[PWM_CH_RED] & 0x03) << 4);
+    CCPR4L = (unsigned char) (pwmDC[PWM_CH_GREEN] >> 2);
+    CCP4CON = (CCP4CON & 0xCF) | ((pwmDC[PWM_CH_GREEN] & 0x03) << 4);
+    CCPR1L = (unsigned char) (pwmDC[PWM_CH_BLUE] >> 2);
+    CCP1CON = (CCP1CON & 0xCF) | ((pwmDC[PWM_CH_BLUE] & 0x03) << 4);
+
+    TMR2IF = 0; //clear timer 2 interrupt flag
+
+    //no dithering and no boost, the duty cycles stay as they are until the next change
+    if ((boost == 0) && (pwmDither == 0))
+        TMR2IE = 0;
+}
+
+// Replace the RGB levels of every zone right away, meant to be called from the interrupt
+void PWMLoadLevels(const unsigned int *rgb)
+{
+    pwmDither = 0;
+    for (unsigned char i = 0; i < 3; i++)
+    {
+        pwmBaseDC[i] = rgb[i] >> PWM_FRAC_BITS;
+        pwmFrac[i] = (unsigned char) (rgb[i] << (8 - PWM_FRAC_BITS));
+        pwmDither |= pwmFrac[i];
+    }
+    pwmLatchReq = 0;
+    PWM_RESTART_PERIOD();
+}
+
+#else
+
+/*--------------------------------------------------------------------------------------
+ Software PWM, PWMTick() is called from the Timer 1 interrupt.
+
+ The levels are turned into a schedule: the channels sorted by duty cycle into a list of
+ edges, every edge holds the step at which it happens and the PORTA/PORTB bits of all the
+ channels that switch off at that step. PWMLatch() builds the schedule in main context in
+ the spare buffer and the interrupt switches to it at the start of the next period, so a
+ fade does not stretch the PWM periods. PWMLoadLevels() uses the same spare buffer, while
+ PWMLatch() is building it (pwmBusy) the levels of PWMLoadLevels() are dropped. There are
+ only two buffers of 40 bytes (7 channels), each fits in a RAM bank of the PIC16F628A. At the start of a period all the active outputs
+ are switched on, after that a tick only compares the step counter with the next edge and
+ writes the ports once when it is reached. The cost of a tick does not depend on the
+ number of channels and the outputs of a port always switch in the same instruction.
+
+ Channels extended by the dithering switch off one step after their edge (pwmLateA/B).
+ The boost moves all the edges to later steps.
+
+ The interrupt code is kept flat, the PIC16F628A has an 8 level hardware stack. PWMTick()
+ only calls PWMBuildEdges() for the levels of PWMLoadLevels() (once per beat in the sound
+ mode).
+
+ The outputs are switched in shadow copies of the ports. Bit writes on PORTA would read
+ back RA0~RA3 as '0' when they are comparator inputs (sound mode) and clear the LED
+ outputs on RA0/RA1. The host mock runs the same code without the port writes.
+--------------------------------------------------------------------------------------*/
+
+#if PWM_BACKEND == PWM_BACKEND_HOST
+unsigned char pwmHostEnabled;
+
+#define PWM_PORTA_WRITE()
+#define PWM_PORTB_WRITE()
+#define PWM_TIMER_RELOAD()
+#else
+#define PWM_PORTA_WRITE()       (PORTA = pwmPortA)
+#define PWM_PORTB_WRITE()       (PORTB = pwmPortB)
+#define PWM_TIMER_RELOAD()      {TMR1IF = 0; TMR1H = 0xFF; TMR1L = 0x78;}	//clear the flag and reload the timer for the next interrupt
+#endif
+
+#define PWM_RESTART_PERIOD()    (pwmCntr = PWM_MAX_DUTY - 1)	//the next tick starts a new period
+
+const unsigned char pwmBitA[PWM_CHANNELS] = {
+    PWM_BIT_RED, PWM_BIT_GREEN, PWM_BIT_BLUE
+#ifdef PWM_WHITE_EN
+    , PWM_BIT_WHITE
+#endif
+#ifdef PWM_ZONE2_EN
+    , 0, 0, 0
+#endif
+};
+
+const unsigned char pwmBitB[PWM_CHANNELS] = {
+    0, 0, 0
+#ifdef PWM_WHITE_EN
+    , 0
+#endif
+#ifdef PWM_ZONE2_EN
+    , PWM_BIT_RED2, PWM_BIT_GREEN2, PWM_BIT_BLUE2
+#endif
+};
+
+unsigned char pwmPortA;					// shadow of PORTA
+unsigned char pwmPortB;					// shadow of PORTB
+
+unsigned char pwmCntr;					// position in the current PWM period
+
+struct Schedule {
+    unsigned char dc[PWM_CHANNELS];		// duty cycle of every channel
+    unsigned char frac[PWM_CHANNELS];	// fraction of every channel for dithering, left aligned to 8 bits
+    unsigned char step[PWM_CHANNELS + 1];	// edges sorted by step, closed by an edge at PWM_MAX_DUTY that is never reached
+    unsigned char edgeA[PWM_CHANNELS + 1];	// PORTA bits that switch off at the edge
+    unsigned char edgeB[PWM_CHANNELS + 1];	// PORTB bits that switch off at the edge
+    unsigned char onA, onB;				// channels with a duty cycle
+};
+
+//two separate objects, an array of both would not fit in a RAM bank
+struct Schedule pwmSchedA;
+struct Schedule pwmSchedB;
+struct Schedule *pwmCur;				// schedule used by the interrupt, the other one is the spare
+
+#define PWM_SPARE()             ((pwmCur == &pwmSchedA) ? &pwmSchedB : &pwmSchedA)
+
+volatile unsigned char pwmBusy;			// PWMLatch() is building the spare schedule
+volatile unsigned char pwmSwapReq;		// switch to the spare schedule at the start of the next period
+volatile unsigned char pwmLoadReq;		// build the spare schedule of PWMLoadLevels() at the start of the next period
+
+unsigned char pwmEdgeIdx;				// next edge
+unsigned char pwmEdgeNext;				// step of the next edge including the boost
+unsigned char pwmEdgeShift;				// boost of the current period
+
+unsigned char pwmCarryA, pwmCarryB;		// channels extended by one step in this period
+unsigned char pwmLateA, pwmLateB;		// channels to switch off at the next tick
+
+// Sort the channels by duty cycle and build the list of edges, channels at full duty cycle never switch off
+static void PWMBuildEdges(struct Schedule *sched)
+{
+    unsigned char order[PWM_CHANNELS];
+    unsigned char i, j, ch, n;
+
+    //insertion sort, there are only a few channels
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+    {
+        for (j = ch; (j > 0) && (sched->dc[order[j - 1]] > sched->dc[ch]); j--)
+            order[j] = order[j - 1];
+        order[j] = ch;
+    }
+
+    sched->onA = 0;
+    sched->onB = 0;
+    n = 0;
+    for (i = 0; i < PWM_CHANNELS; i++)
+    {
+        ch = order[i];
+
+        if (sched->dc[ch] != 0)
+        {
+            sched->onA |= pwmBitA[ch];
+            sched->onB |= pwmBitB[ch];
+        }
+
+        if (sched->dc[ch] >= PWM_MAX_DUTY)
+            continue;
+
+        //channels with the same duty cycle share an edge
+        if ((n == 0) || (sched->step[n - 1] != sched->dc[ch]))
+        {
+            sched->step[n] = sched->dc[ch];
+            sched->edgeA[n] = 0;
+            sched->edgeB[n] = 0;
+            n++;
+        }
+        sched->edgeA[n - 1] |= pwmBitA[ch];
+        sched->edgeB[n - 1] |= pwmBitB[ch];
+    }
+
+    sched->step[n] = PWM_MAX_DUTY;
+    sched->edgeA[n] = 0;
+    sched->edgeB[n] = 0;
+}
+
+// Initialize Timer 1 for software PWM generation, outputs stay disabled until PWMEnable()
+void PWMInit(void)
+{
+    for (unsigned char i = 0; i < PWM_CHANNELS; i++)
+    {
+        pwmNextLevel[i] = 0;
+        pwmAcc[i] = 0;
+        pwmSchedA.dc[i] = 0;
+        pwmSchedA.frac[i] = 0;
+    }
+    PWMBuildEdges(&pwmSchedA);
+    pwmCur = &pwmSchedA;
+    pwmBusy = 0;
+    pwmSwapReq = 0;
+    pwmLoadReq = 0;
+    pwmBoost = 0;
+    pwmBoostDecay = 0;
+    pwmCntr = 0;
+    pwmPortA = 0;
+    pwmPortB = 0;
+
+#if PWM_BACKEND == PWM_BACKEND_SOFT
+    GIE = 0;
+    T1CON = 0x00;
+    TMR1CS = 0; // Choose the local clock source (timer mode)
+    // Choose the desired prescaler ratio (1:1)
+    T1CKPS0 = 0;
+    T1CKPS1 = 0;
+    TMR1H = 0xFF; //setup the timer value for 200uS interrupt
+    TMR1L = 0x38;
+
+    TMR1ON = 1; 	//turn on Timer 1
+    TMR1IF = 0; 	//clear timer 1 interrupt flag
+    PEIE = 1; 		// Peripherals Interrupts Enable Bit
+    GIE = 1; 		// Global Interrupts Enable Bit
+#endif
+}
+
+// Start (enable != 0) or stop the software PWM. Stopped outputs are driven low.
+void PWMEnable(unsigned char enable)
+{
+#if PWM_BACKEND == PWM_BACKEND_SOFT
+    TMR1IE = 0;
+#endif
+    PWM_RESTART_PERIOD();
+    pwmPortA &= ~PWM_MASK_A;
+    PWM_PORTA_WRITE();
+#if PWM_MASK_B
+    pwmPortB &= ~PWM_MASK_B;
+    PWM_PORTB_WRITE();
+#endif
+#if PWM_BACKEND == PWM_BACKEND_SOFT
+    if (enable)
+        TMR1IE = 1;
+#else
+    pwmHostEnabled = enable;
+#endif
+}
+
+// Build the schedule of the new levels, the interrupt switches to it at the start of the next period
+void PWMLatch(void)
+{
+    struct Schedule *sched;
+
+    //keep the interrupt off the spare schedule, pwmCur does not change until it is released
+    pwmBusy = 1;
+    pwmSwapReq = 0;
+    pwmLoadReq = 0;
+    sched = PWM_SPARE();
+
+    for (unsigned char i = 0; i < PWM_CHANNELS; i++)
+    {
+        sched->dc[i] = (unsigned char) (pwmNextLevel[i] >> PWM_FRAC_BITS);
+        sched->frac[i] = (unsigned char) (pwmNextLevel[i] << (8 - PWM_FRAC_BITS));
+    }
+    PWMBuildEdges(sched);
+
+    pwmBusy = 0;
+    pwmSwapReq = 1;
+}
+
+// One PWM step, called from the Timer 1 interrupt
+void PWMTick(void)
+{
+    unsigned char clrA, clrB, onA;
+    unsigned int boost;
+
+#if PWM_BACKEND == PWM_BACKEND_HOST
+    if (!pwmHostEnabled)
+        return; //the timer interrupt is disabled
+#endif
+
+    if (++pwmCntr >= PWM_MAX_DUTY)
+    {
+        //start of a new period, pick up a new schedule
+        if (pwmLoadReq)
+        {
+            if (!pwmBusy)
+            {
+                PWMBuildEdges(PWM_SPARE());
+                pwmSwapReq = 1;
+            }
+            pwmLoadReq = 0;
+        }
+        if (pwmSwapReq)
+        {
+            pwmCur = PWM_SPARE();
+            pwmSwapReq = 0;
+        }
+
+        //dithering, the carry gives one extra step in this period
+        pwmCarryA = 0;
+        pwmCarryB = 0;
+        for (unsigned char i = 0; i < PWM_CHANNELS; i++)
+        {
+            pwmAcc[i] += pwmCur->frac[i];
+            if (pwmAcc[i] < pwmCur->frac[i])
+            {
+                pwmCarryA |= pwmBitA[i];
+                pwmCarryB |= pwmBitB[i];
+            }
+        }
+
+        onA = pwmCur->onA | pwmCarryA;
+
+        PWM_BOOST_NEXT(boost);
+        pwmEdgeShift = (boost > PWM_MAX_DUTY) ? PWM_MAX_DUTY : (unsigned char) boost;
+        if (pwmEdgeShift)
+            onA = PWM_MASK_A;
+
+        //an edge at step 0 is never reached, channels at 0 extended by the dithering switch off at step 1
+        pwmEdgeIdx = 0;
+        pwmLateA = 0;
+        pwmLateB = 0;
+        if ((pwmCur->step[0] == 0) && (pwmEdgeShift == 0))
+        {
+            pwmLateA = pwmCur->edgeA[0] & pwmCarryA;
+            pwmLateB = pwmCur->edgeB[0] & pwmCarryB;
+            pwmEdgeIdx = 1;
+        }
+        pwmEdgeNext = pwmCur->step[pwmEdgeIdx] + pwmEdgeShift;
+
+        //start of the period, drive the PWM outputs HIGH
+        pwmPortA = (pwmPortA & ~PWM_MASK_A) | onA;
+        PWM_PORTA_WRITE();
+#if PWM_MASK_B
+        pwmPortB = (pwmPortB & ~PWM_MASK_B) | (pwmEdgeShift ? PWM_MASK_B : (pwmCur->onB | pwmCarryB));
+        PWM_PORTB_WRITE();
+#endif
+
+        pwmCntr = 0; // Reset Counter
+        pwmPeriods++;
+    }
+    else
+    {
+        clrA = pwmLateA;
+        clrB = pwmLateB;
+        pwmLateA = 0;
+        pwmLateB = 0;
+
+        //Duty Cycle Check, drive the PWM outputs of the edge LOW
+        if (pwmCntr == pwmEdgeNext)
+        {
+            clrA |= pwmCur->edgeA[pwmEdgeIdx] & ~pwmCarryA;
+            clrB |= pwmCur->edgeB[pwmEdgeIdx] & ~pwmCarryB;
+            pwmLateA = pwmCur->edgeA[pwmEdgeIdx] & pwmCarryA;
+            pwmLateB = pwmCur->edgeB[pwmEdgeIdx] & pwmCarryB;
+            pwmEdgeIdx++;
+            pwmEdgeNext = pwmCur->step[pwmEdgeIdx] + pwmEdgeShift;
+        }
+
+        if (clrA)
+        {
+            pwmPortA &= ~clrA;
+            PWM_PORTA_WRITE();
+        }
+#if PWM_MASK_B
+        if (clrB)
+        {
+            pwmPortB &= ~clrB;
+            PWM_PORTB_WRITE();
+        }
+#endif
+    }
+
+    PWM_TIMER_RELOAD();
+}
+
+// Replace the RGB levels of every zone at the start of the next period, meant to be called from the interrupt.
+// The other channels keep the levels in use (or latched). Dropped while PWMLatch() is building new levels.
+void PWMLoadLevels(const unsigned int *rgb)
+{
+    struct Schedule *sched;
+    unsigned char ch;
+
+    if (pwmBusy)
+        return;
+
+    sched = PWM_SPARE();
+    if (!pwmSwapReq)
+    {
+        for (ch = 0; ch < PWM_CHANNELS; ch++)
+        {
+            sched->dc[ch] = pwmCur->dc[ch];
+            sched->frac[ch] = pwmCur->frac[ch];
+        }
+    }
+
+    for (unsigned char zone = 0; zone < PWM_ZONES; zone++)
+    {
+        for (unsigned char i = 0; i < 3; i++)
+        {
+            ch = PWM_ZONE_CH(zone, i);
+            sched->dc[ch] = (unsigned char) (rgb[i] >> PWM_FRAC_BITS);
+            sched->frac[ch] = (unsigned char) (rgb[i] << (8 - PWM_FRAC_BITS));
+        }
+    }
+
+    pwmSwapReq = 0;
+    pwmLoadReq = 1;
+    PWM_RESTART_PERIOD();
+}
+
+#endif
+
+// Set the level (0 ~ PWM_MAX_LEVEL, PWM_FRAC_BITS below one PWM step) of a channel, it takes effect after PWMLatch()
+void PWMSetLevel(unsigned char channel, unsigned int level)
+{
+    if (channel >= PWM_CHANNELS)
+        return;
+
+    if (level > PWM_MAX_LEVEL)
+        level = PWM_MAX_LEVEL;
+
+#if PWM_BACKEND == PWM_BACKEND_CCP
+    pwmLatchReq = 0; //hold off the interrupt until the 16 bit level is written and latched again
+#endif
+    pwmNextLevel[channel] = level;
+}
+
+// Set the duty cycle (0 ~ PWM_MAX_DUTY) of a channel, it takes effect after PWMLatch()
+void PWMSetDuty(unsigned char channel, unsigned int duty)
+{
+    if (duty > PWM_MAX_DUTY)
+        duty = PWM_MAX_DUTY;
+
+    PWMSetLevel(channel, duty << PWM_FRAC_BITS);
+}
+
+// Raise all the channels by boost duty cycle steps, the boost drops by decay every period.
+// Meant to be called from the interrupt, the new period starts within one PWM step.
+void PWMBoost(unsigned int boost, unsigned int decay)
+{
+    pwmBoost = boost;
+    pwmBoostDecay = decay;
+    PWM_RESTART_PERIOD();
+}
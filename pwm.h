@@ -0,0 +1,150 @@
+/*--------------------------------------------------------------------------------------
+ PWM.H - Header file for the LED PWM driver.
+ Copyright (C) 2020 Jagannatha Rao (aka JagiChan) (jagannath_raous@yahoo.com)
+
+ The LED outputs are driven through a small driver interface so that the rest of the
+ software does not care how the PWM is generated. Three backends are available:
+
+	(a) PWM_BACKEND_SOFT - software PWM generated in the Timer 1 interrupt (PIC16F628A, 4Mhz).
+	    100 steps, the CPU has to service every PWM step. Up to 7 channels, see below.
+	(b) PWM_BACKEND_CCP  - hardware PWM using the CCP modules of the enhanced mid-range
+	    parts like the PIC16F1827/1847 running at 32Mhz. 10 bit resolution. The Timer 2
+	    interrupt only runs while a channel is dithered or boosted, a steady color has no CPU load.
+	    Red = CCP2 on RA7, Green = CCP4 on RA4, Blue = CCP1 on RB0 (alternate pin function).
+	    Only the three RGB channels.
+	(c) PWM_BACKEND_HOST - host mock of the software PWM used to compile and exercise the
+	    driver on a PC. The pin states are kept in pwmPortA and pwmPortB.
+
+ Software PWM channels
+ ---------------------
+	Zone 1: Red RA7, Green RA0, Blue RA1
+	White : RA6 (define PWM_WHITE_EN)
+	Zone 2: Red RB0, Green RB6, Blue RB7 (define PWM_ZONE2_EN)
+
+	Every zone sits on a single port, so all the outputs of a zone switch together.
+
+ On top of the PWM steps the driver dithers the duty cycle over successive periods, so the
+ level of a channel can be set with PWM_FRAC_BITS more resolution (PWMSetLevel()).
+
+ The backend is selected automatically from the compiler/device unless PWM_BACKEND is
+ defined on the compiler command line.
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------------------------*/
+
+#ifndef PWM_H
+#define	PWM_H
+
+#define PWM_BACKEND_SOFT    0
+#define PWM_BACKEND_CCP     1
+#define PWM_BACKEND_HOST    2
+
+#ifndef PWM_BACKEND
+#if !defined(__XC8)
+#define PWM_BACKEND PWM_BACKEND_HOST	//not built with XC8, use the host mock
+#elif defined(_PIC14E)
+#define PWM_BACKEND PWM_BACKEND_CCP		//enhanced mid-range part with CCP modules
+#else
+#define PWM_BACKEND PWM_BACKEND_SOFT	//PIC16F628A
+#endif
+#endif
+
+//PWM channels
+#define PWM_CH_RED      0
+#define PWM_CH_GREEN    1
+#define PWM_CH_BLUE     2
+
+#if PWM_BACKEND == PWM_BACKEND_CCP
+#undef PWM_WHITE_EN
+#undef PWM_ZONE2_EN
+#endif
+
+#ifdef PWM_WHITE_EN
+#define PWM_CH_WHITE    3
+#define PWM_ZONE2_CH    4				//first channel of zone 2
+#else
+#define PWM_ZONE2_CH    3
+#endif
+
+#ifdef PWM_ZONE2_EN
+#define PWM_ZONES       2
+#define PWM_CHANNELS    (PWM_ZONE2_CH + 3)
+#else
+#define PWM_ZONES       1
+#define PWM_CHANNELS    PWM_ZONE2_CH
+#endif
+
+//channel of a color (PWM_CH_RED/GREEN/BLUE) in a zone (0 ~ PWM_ZONES-1)
+#define PWM_ZONE_CH(zone, color)    (((zone) ? PWM_ZONE2_CH : 0) + (color))
+
+#if PWM_BACKEND == PWM_BACKEND_CCP
+#define PWM_MAX_DUTY    1023			//10 bit duty cycle (PR2 = 0xFF)
+#define PWM_FRAC_BITS   6				//16 bit levels
+#define PWM_SEED_REG    TMR2			//free running timer used to seed rand()
+#else
+#define PWM_MAX_DUTY    100				//number of software PWM steps per period
+#define PWM_FRAC_BITS   8				//100 x 256 levels (~14.6 bits)
+#define PWM_SEED_REG    TMR1L
+#endif
+
+#define PWM_MAX_LEVEL   ((unsigned int) PWM_MAX_DUTY << PWM_FRAC_BITS)
+
+//convert an 8 bit color value (0~255) to a level (0 ~ PWM_MAX_LEVEL)
+#if PWM_MAX_DUTY == 100
+//c * 25600 / 255 within one level (exact for 0 and 255) with 16 bit math
+#define PWM_COLOR_TO_LEVEL(c)   ((unsigned int) (c) * 100 + (((unsigned int) (c) * 101) >> 8))
+#else
+#define PWM_COLOR_TO_LEVEL(c)   ((unsigned int) (((unsigned long) (c) * PWM_MAX_LEVEL) / 255))
+#endif
+
+extern volatile unsigned char pwmPeriods;	//incremented at the start of every PWM period (CCP: only while the interrupt runs)
+
+#if PWM_BACKEND != PWM_BACKEND_CCP
+//port bits of the channels
+#define PWM_BIT_RED     0x80			//RA7
+#define PWM_BIT_GREEN   0x01			//RA0
+#define PWM_BIT_BLUE    0x02			//RA1
+#define PWM_BIT_WHITE   0x40			//RA6
+#define PWM_BIT_RED2    0x01			//RB0
+#define PWM_BIT_GREEN2  0x40			//RB6
+#define PWM_BIT_BLUE2   0x80			//RB7
+
+#ifdef PWM_WHITE_EN
+#define PWM_MASK_A      (PWM_BIT_RED | PWM_BIT_GREEN | PWM_BIT_BLUE | PWM_BIT_WHITE)
+#else
+#define PWM_MASK_A      (PWM_BIT_RED | PWM_BIT_GREEN | PWM_BIT_BLUE)
+#endif
+
+#ifdef PWM_ZONE2_EN
+#define PWM_MASK_B      (PWM_BIT_RED2 | PWM_BIT_GREEN2 | PWM_BIT_BLUE2)
+#else
+#define PWM_MASK_B      0x00
+#endif
+
+extern const unsigned char pwmBitA[PWM_CHANNELS];	//PORTA bit of every channel (0 if on PORTB)
+extern const unsigned char pwmBitB[PWM_CHANNELS];	//PORTB bit of every channel (0 if on PORTA)
+extern unsigned char pwmPortA;			//shadows of the LED bits of PORTA and PORTB
+extern unsigned char pwmPortB;
+#endif
+
+#if PWM_BACKEND == PWM_BACKEND_HOST
+extern unsigned char pwmHostEnabled;	//set by PWMEnable(), the timer interrupt is only simulated when set
+#endif
+
+void PWMInit(void);
+void PWMSetDuty(unsigned char channel, unsigned int duty);
+void PWMSetLevel(unsigned char channel, unsigned int level);
+void PWMLatch(void);
+void PWMEnable(unsigned char enable);
+void PWMTick(void);
+void PWMBoost(unsigned int boost, unsigned int decay);
+void PWMLoadLevels(const unsigned int *rgb);
+
+#endif	/* PWM_H */
+
@@ -2,19 +2,31 @@
  RGBMAIN.C - Header file for the RGBMoodlight.
  Copyright (C) 2020 Jagannatha Rao (aka JagiChan) (jagannath_raous@yahoo.com)
 
- (1) Uses software PWM to generate 3 PWM with fixed frequency and variable duty cycle.
+ (1) Uses the PWM driver (software PWM on the PIC16F628A, CCP modules on the PIC16F1827/1847)
+     to generate the PWM for the RGB LED's (optionally a white LED and a second RGB zone) with fixed frequency
+     and variable duty cycle.
  (2) Generates Random colors or user selected color
  (3) Colors can be generated using either the buttons or by using commands on the USART. 
- (4) User selected color is stored in the EEPROM and restored during power on
+ (4) User selected color and the settings are stored in a CRC protected block in the EEPROM (config.c)
+     and restored during power on, the light comes up at the stored color before the USART is started.
  
  USART commands
  --------------
 	(a) Send RRGGBB to trigger the color. The color generated is stored in the EEPROM.
 	(b) Send X or x to clear the stored color and return to random color generation.
+	(c) Send ZnRRGGBB to set the color of zone n (1~2) only. This color is not stored in the EEPROM.
+	(d) Send Lnvv to set channel n to the value vv (00~FF). Channels are 1~3 for red, green and blue, 4 for white
+	    (with PWM_WHITE_EN) and the next three for red, green and blue of zone 2 (with PWM_ZONE2_EN).
+	(e) Send Sn or Snt to select the sound reactive mode n (0 = off, 1 = flash, 2 = pulse, 3 = palette step)
+	    with the optional comparator threshold t (0~F). Needs SOUND_EN and a microphone on RA2/RA3.
+	    The sound mode is stored in the EEPROM and used at power on.
+	(f) Send Unnnn to switch to baud rate nnnn (9600, 19200 and on 32Mhz parts 38400, 57600, 115200).
+	    OK is sent at the old baud rate before switching, ERR if the rate is not supported.
+	    The baud rate is stored in the EEPROM and used at power on.
 
  BUTTONS
  -------
-	(a) Keep Red, Green and Blue buttons pressed at power on to clear the EEPROM and user selected color.
+	(a) Keep Red, Green and Blue buttons pressed at power on to clear the EEPROM, user selected color, baud rate and sound mode.
 	    The entire display will blink 5 times to indicate that the EEPROM has been cleared.
 	(b) Press Red and Green buttons simultaneously when a color is being displayed to store the color in the EEPROM.
 	    The entire display will blink 3 times to indicate that the selected color has been saved in the EEPROM
@@ -33,62 +45,44 @@
 #include "rgbmain.h"
 #include "usart.h"
 #include "eeprom.h"
+#include "sound.h"
+#include "config.h"
 
 //initial eeprom data
 __EEPROM_DATA(0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00);
 
 // map of the colors which are defined as RRGGBB
-const unsigned long colors[] = {0xFF0000, 0x00FF00, 0x0000FF, 0xFFFF00, 0x00FFFF, 0xFF00FF, 0xFFFFFF, 0x9400D3};
+#define LED_COLOR(rgb)  rgb,
+const unsigned long colors[] = {LED_COLOR_MAP(LED_COLOR)};
 
-unsigned int TMR1_Cntr;
 unsigned char usartCRChar;
 unsigned long userColor;
 unsigned char userColorSelected;
-unsigned char PWM_RedDC = 0, PWM_BlueDC = 0, PWM_GreenDC = 0;	// duty cycle for RGB pins
+unsigned long ledColor;			// color shown on all the zones (RRGGBB), saved as the user color
+unsigned char PWM_RedDC = 0, PWM_BlueDC = 0, PWM_GreenDC = 0;	// duty cycle for RGB pins (0~100)
 
-// The interrupt function used to generate the software PWM
+// The interrupt function used to generate the software PWM and receive the USART data
 void __interrupt() myISR()
 {
-    if (TMR1IF)
+#if PWM_BACKEND == PWM_BACKEND_SOFT
+    if (TMR1IE && TMR1IF) //the flag is also set while the PWM is stopped
     {
-        TMR1_Cntr++;
-
-        //Red Duty Cycle Check
-        if (TMR1_Cntr >= PWM_RedDC)
-        {
-            LedPinRed = 0; // Drive PWM Output LOW
-        }
-
-        //Green Duty Cycle Check
-        if (TMR1_Cntr >= PWM_GreenDC)
-        {
-            LedPinGreen = 0; // Drive PWM Output LOW
-        }
-
-        //Blue Duty Cycle Check
-        if (TMR1_Cntr >= PWM_BlueDC)
-        {
-            LedPinBlue = 0; // Drive PWM Output LOW
-        }
-
-        if (TMR1_Cntr == 100)
-        {
-            if (PWM_RedDC != 0)
-                LedPinRed = 1; // Drive PWM Output HIGH
-
-            if (PWM_GreenDC != 0)
-                LedPinGreen = 1;
-
-            if (PWM_BlueDC != 0)
-                LedPinBlue = 1;
-
-            TMR1_Cntr = 0; // Reset Counter
-        }
+        PWMTick(); //next step of the software PWM
+    }
+#elif PWM_BACKEND == PWM_BACKEND_CCP
+    if (TMR2IE && TMR2IF)
+    {
+        PWMTick(); //dithered duty cycles for the next hardware PWM period
+    }
+#endif
 
-        TMR1IF = 0; //clear timer 1 interrupt flag
-        TMR1H = 0xFF; //reload the timer 1 for next interrupt
-        TMR1L = 0x78;
+#ifdef SOUND_EN
+    //comparator output changed, microphone envelope crossed the threshold
+    if (CMIF)
+    {
+        SoundHandleInt();
     }
+#endif
 
 
     //character received on USART
@@ -112,42 +106,25 @@ int map(unsigned char x, unsigned char in_min, unsigned char in_max, unsigned ch
     return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
 
-// Confirms user operations by blinking the three LED's. This function takes number of blinks as input.
-void confirmOperation(unsigned char blinks)
+// Set all the RGB LED's to the same duty cycle
+void ledSetAll(unsigned int duty)
 {
-    GIE = OFF; //turn off the global interrupts
-
-    for (unsigned char i = blinks; i > 0; i--)
+    for (unsigned char zone = 0; zone < PWM_ZONES; zone++)
     {
-        CLRWDT(); //kick the dog
-        //turn on all the LED's
-        LedPinRed = ON;
-        LedPinGreen = ON;
-        LedPinBlue = ON;
-        //wait for 500 ms
-        __delay_ms(500);
-        //turn off the LED's
-        LedPinRed = OFF;
-        LedPinGreen = OFF;
-        LedPinBlue = OFF;
-        //wait for 500 ms
-        __delay_ms(500);
+        PWMSetDuty(PWM_ZONE_CH(zone, PWM_CH_RED), duty);
+        PWMSetDuty(PWM_ZONE_CH(zone, PWM_CH_GREEN), duty);
+        PWMSetDuty(PWM_ZONE_CH(zone, PWM_CH_BLUE), duty);
     }
-
-    GIE = ON; //turn on the global interrupts
+    PWMLatch();
 }
 
-// Intialize the PWM to zero for soft start, reset usercolor selection.
-void ledInit(void)
+// Set the color of one zone, it takes effect after PWMLatch()
+void ledZoneSet(unsigned char zone, unsigned long color)
 {
-    //create a soft pwm, original duty cycle is 0Hz, range is 0~100
-    PWM_RedDC = 0;
-    PWM_GreenDC = 0;
-    PWM_BlueDC = 0;
-    TMR1_Cntr = 0;
-    usartCRChar = 0;
-    userColor = 0;
-    userColorSelected = FALSE;
+    //the driver dithers below one PWM step, so use the full 8 bit color value
+    PWMSetLevel(PWM_ZONE_CH(zone, PWM_CH_RED), PWM_COLOR_TO_LEVEL((unsigned char) (color >> 16)));
+    PWMSetLevel(PWM_ZONE_CH(zone, PWM_CH_GREEN), PWM_COLOR_TO_LEVEL((unsigned char) (color >> 8)));
+    PWMSetLevel(PWM_ZONE_CH(zone, PWM_CH_BLUE), PWM_COLOR_TO_LEVEL((unsigned char) color));
 }
 
 // Set the selected color and adapt the PWM to generate the color
@@ -168,43 +145,83 @@ void ledColorSet(unsigned long color) //set color, for example: 0xde3f47
     PWM_GreenDC = g_val;
     PWM_BlueDC = b_val;
 
-    if (userColorSelected)
+    //all the zones show the same color, called directly to keep the stack shallow
+    ledColor = color;
+    for (unsigned char zone = 0; zone < PWM_ZONES; zone++)
+        ledZoneSet(zone, color);
+    PWMLatch();
+}
+
+// Show the color of the 0~100 duty cycles of the RGB pins (set by the buttons)
+void ledDutyUpdate(void)
+{
+    ledColorSet(((unsigned long) LED_PCT_TO_COLOR(PWM_RedDC) << 16) | (LED_PCT_TO_COLOR(PWM_GreenDC) << 8) | LED_PCT_TO_COLOR(PWM_BlueDC));
+}
+
+// Confirms user operations by blinking the three LED's. This function takes number of blinks as input.
+void confirmOperation(unsigned char blinks)
+{
+    for (unsigned char i = blinks; i > 0; i--)
     {
-        EEwrite(RED_ADDR, PWM_RedDC); //save the red duty cycle
-        EEwrite(GRN_ADDR, PWM_GreenDC);
-        EEwrite(BLU_ADDR, PWM_BlueDC);
+        CLRWDT(); //kick the dog
+        //turn on all the LED's
+        ledSetAll(PWM_MAX_DUTY);
+        //wait for 500 ms
+        __delay_ms(500);
+        //turn off the LED's
+        ledSetAll(0);
+        //wait for 500 ms
+        __delay_ms(500);
     }
+
+    ledColorSet(ledColor); //back to the color being displayed
 }
 
-// Initialize the Timer1 for software PWM generation
-void InitTimer1()
+// Intialize the PWM to zero for soft start, reset usercolor selection.
+void ledInit(void)
 {
-    GIE = OFF;
-    T1CON = 0x00;
-    TMR1CS = 0; // Choose the local clock source (timer mode)
-    // Choose the desired prescaler ratio (1:1)
-    T1CKPS0 = 0;
-    T1CKPS1 = 0;
-    TMR1H = 0xFF; //setup the timer value for 200uS interrupt
-    TMR1L = 0x38;
-
-    TMR1ON = ON; 	//turn on Timer 1
-    TMR1IF = 0; 	//clear timer 1 interrupt flag
-    TMR1IE = ON; 	//enable timer 1 interrupt
-    PEIE = ON; 		// Peripherals Interrupts Enable Bit
-    GIE = ON; 		// Global Interrupts Enable Bit
+    //create a soft pwm, original duty cycle is 0Hz, range is 0~100
+    PWM_RedDC = 0;
+    PWM_GreenDC = 0;
+    PWM_BlueDC = 0;
+    usartCRChar = 0;
+    userColor = 0;
+    userColorSelected = FALSE;
+    ledColorSet(0);
+}
+
+// Store the color being displayed as the user color in the EEPROM, with the full 8 bit values
+void ledColorSave(void)
+{
+    config.red = (unsigned char) (ledColor >> 16);
+    config.green = (unsigned char) (ledColor >> 8);
+    config.blue = (unsigned char) ledColor;
+    config.flags |= CFG_USER_COLOR;
+    ConfigSave();
 }
 
 void initHW(void)
 {
     GIE = OFF; 		//disable global the interrupts
+#if defined(_PIC14E)
+    OSCCON = 0b01110000;	//8Mhz internal clock, 4x PLL enabled by the configuration word
+    ANSELA = 0x00;			//all pins are digital
+    ANSELB = 0x00;
+    //setup port pins
+    TRISA = 0b01101111; 	//RA4 (CCP4),RA7 (CCP2) are outputs
+    TRISB = 0b00111010; 	//RX is input; RB3,RB4,RB5 are inputs; RB0 (CCP1) is output
+    WPUB = 0x00;
+    LATA = 0x00;			//Clear Port A
+    LATB = 0x00;			//Clear Port B
+#else
     CMCON = 7; 		//disable the comparators
     PCON = 0x08;
     //setup port pins
-    TRISA = 0b01111100; 	//RA0,RA1,RA7 are outputs
-    TRISB = 0b00111011; 	//RX is input; RB3,RB4,RB5 are inputs
+    TRISA = (unsigned char) ~PWM_MASK_A; 			//LED pins (RA0,RA1,RA7 and RA6 for white) are outputs
+    TRISB = 0b00111011 & (unsigned char) ~PWM_MASK_B;	//RX is input; RB3,RB4,RB5 are inputs; zone 2 LED pins are outputs
     PORTA = 0x00;			//Clear Port A
     PORTB = 0x00;			//Clear Port B
+#endif
     GIE = ON; 				//enable global interrupts
 }
 
@@ -218,17 +235,100 @@ void ResetUSARTBuffer(void)
     usartCRChar = FALSE;
 }
 
+// Convert a hex character to its value, anything else is 0
+unsigned char hexToValue(unsigned char ch)
+{
+    switch (ch)
+    {
+        case '0':
+            ch = 0;
+            break;
+
+        case '1':
+            ch = 1;
+            break;
+
+        case '2':
+            ch = 2;
+            break;
+
+        case '3':
+            ch = 3;
+            break;
+
+        case '4':
+            ch = 4;
+            break;
+
+        case '5':
+            ch = 5;
+            break;
+
+        case '6':
+            ch = 6;
+            break;
+
+        case '7':
+            ch = 7;
+            break;
+
+        case '8':
+            ch = 8;
+            break;
+
+        case '9':
+            ch = 9;
+            break;
+
+        case 'A':
+        case 'a':
+            ch = 10;
+            break;
+
+        case 'B':
+        case 'b':
+            ch = 11;
+            break;
+
+        case 'C':
+        case'c':
+            ch = 12;
+            break;
+
+        case 'D':
+        case'd':
+            ch = 13;
+            break;
+
+        case 'E':
+        case'e':
+            ch = 14;
+            break;
+
+        case 'F':
+        case 'f':
+            ch = 15;
+            break;
+
+        default:
+            ch = 0;
+            break;
+    }
+
+    return ch;
+}
+
 // Process USART received data
 void processUSART(void)
 {
     unsigned char tempCharStorage;
+    unsigned char zone = PWM_ZONES;	//all the zones
 
     userColor = 0;
 
     if (usartCRChar)
     {
         CLRWDT(); //kick the dog (only 2.4 seconds available until dog barks)
-        userColorSelected = TRUE;
         while (bufferRead(&tempCharStorage) == BUFFER_OK)
         {
             // if character 'X' or 'x' is sent on Serial port or detected in the color combination
@@ -237,126 +337,182 @@ void processUSART(void)
             {
                 userColorSelected = FALSE;	//clear the userColorSelected flag
                 userColor = 0;				//reset userColor
-                EEwrite(RED_ADDR, 0); 		//reset the red, green and blue duty cycle and store in EEPROM
-                EEwrite(GRN_ADDR, 0);
-                EEwrite(BLU_ADDR, 0);
+                config.flags &= ~CFG_USER_COLOR;	//forget the user color in the EEPROM
+                ConfigSave();
                 ResetUSARTBuffer();			//clear the USART buffer for next reception
                 return; //exit this loop
             }
 
+#ifdef SOUND_EN
+            // 'S' followed by the sound mode (0~3) and optionally the threshold (0~F) selects the sound reactive mode.
+            // So S2 pulses the color on every beat and S0 switches the sound mode off.
+            if ((tempCharStorage == 'S') || (tempCharStorage == 's'))
+            {
+                unsigned char mode = SOUND_OFF;
+                unsigned char threshold = SOUND_DEF_THRESHOLD;
+
+                if (bufferRead(&tempCharStorage) == BUFFER_OK)
+                    mode = hexToValue(tempCharStorage);
+                if (bufferRead(&tempCharStorage) == BUFFER_OK)
+                    threshold = hexToValue(tempCharStorage);
+                SoundSetMode(mode, threshold);
+                config.soundMode = soundMode;	//SOUND_OFF if the mode was invalid
+                config.soundThreshold = threshold;
+                ConfigSave();
+                ResetUSARTBuffer();			//clear the USART buffer for next reception
+                return;
+            }
+#endif
+
+            // 'L' followed by the channel (1~7) and the value (00~FF) sets a single channel.
+            // So L4FF sets the white channel to full brightness.
+            if ((tempCharStorage == 'L') || (tempCharStorage == 'l'))
+            {
+                unsigned char channel = PWM_CHANNELS;
+                unsigned char value = 0;
+
+                if (bufferRead(&tempCharStorage) == BUFFER_OK)
+                    channel = hexToValue(tempCharStorage) - 1;
+                if (channel >= PWM_CHANNELS)	//ignore the command if the channel does not exist
+                {
+                    ResetUSARTBuffer();		//clear the USART buffer for next reception
+                    return;
+                }
+                while (bufferRead(&tempCharStorage) == BUFFER_OK)
+                {
+                    value <<= 4;
+                    value += hexToValue(tempCharStorage);
+                }
+                PWMSetLevel(channel, PWM_COLOR_TO_LEVEL(value));
+                PWMLatch();
+
+                //keep the color being displayed in step, it is saved and adjusted by the buttons
+                if (channel == PWM_CH_RED)
+                {
+                    PWM_RedDC = map(value, 0, 255, 0, 100);
+                    ledColor = (ledColor & 0x00FFFF) | ((unsigned long) value << 16);
+                }
+                else if (channel == PWM_CH_GREEN)
+                {
+                    PWM_GreenDC = map(value, 0, 255, 0, 100);
+                    ledColor = (ledColor & 0xFF00FF) | ((unsigned int) value << 8);
+                }
+                else if (channel == PWM_CH_BLUE)
+                {
+                    PWM_BlueDC = map(value, 0, 255, 0, 100);
+                    ledColor = (ledColor & 0xFFFF00) | value;
+                }
+                userColorSelected = TRUE;	//stop the random colors
+                ResetUSARTBuffer();			//clear the USART buffer for next reception
+                return;
+            }
+
+            // 'U' followed by the baud rate in decimal switches the baud rate, so U19200 selects 19200 baud.
+            // The answer goes out at the old baud rate. The letter is not a hex digit, so it can not clash with a color.
+            if ((tempCharStorage == 'U') || (tempCharStorage == 'u'))
+            {
+                unsigned long baudRate = 0;
+                unsigned char baud;
+
+                while (bufferRead(&tempCharStorage) == BUFFER_OK)
+                {
+                    if ((tempCharStorage < '0') || (tempCharStorage > '9'))
+                    {
+                        baudRate = 0;			//not a number, answered with ERR
+                        break;
+                    }
+                    baudRate *= 10;
+                    baudRate += tempCharStorage - '0';
+                }
+                ResetUSARTBuffer();			//clear the USART buffer for next reception
+
+                baud = USARTFindBaud(baudRate);
+                if (baud >= USART_BAUD_COUNT)
+                {
+                    USARTWriteConstLine("ERR");
+                    USARTGotoNewLine();
+                    return;
+                }
+
+                USARTWriteConstLine("OK");
+                USARTGotoNewLine();
+                USARTSetBaud(baud);			//waits for the OK to be sent
+                config.baud = baud;
+                ConfigSave();
+                return;
+            }
+
+            // 'Z' followed by the zone (1~2) in front of the color sets the color of that zone only.
+            // So Z2FF0000 makes zone 2 red.
+            if ((tempCharStorage == 'Z') || (tempCharStorage == 'z'))
+            {
+                if (bufferRead(&tempCharStorage) == BUFFER_OK)
+                    zone = hexToValue(tempCharStorage) - 1;
+                if (zone >= PWM_ZONES)		//ignore the command if the zone does not exist
+                {
+                    ResetUSARTBuffer();		//clear the USART buffer for next reception
+                    return;
+                }
+                continue;
+            }
+
 			// assimilate and assemble the user provided color sequence.
 			// The color sequence should be provided as RRGGBB (the values are interpreted as Hex)
 			// So to trigger an orange color you should send FFFF00 (which means Red = FF, Green = FF, Blue = 0)
-            switch (tempCharStorage)
-            {
-                case '0':
-                    tempCharStorage = 0;
-                    break;
-
-                case '1':
-                    tempCharStorage = 1;
-                    break;
-
-                case '2':
-                    tempCharStorage = 2;
-                    break;
-
-                case '3':
-                    tempCharStorage = 3;
-                    break;
-
-                case '4':
-                    tempCharStorage = 4;
-                    break;
-
-                case '5':
-                    tempCharStorage = 5;
-                    break;
-
-                case '6':
-                    tempCharStorage = 6;
-                    break;
-
-                case '7':
-                    tempCharStorage = 7;
-                    break;
-
-                case '8':
-                    tempCharStorage = 8;
-                    break;
-
-                case '9':
-                    tempCharStorage = 9;
-                    break;
-
-                case 'A':
-                case 'a':
-                    tempCharStorage = 10;
-                    break;
-
-                case 'B':
-                case 'b':
-                    tempCharStorage = 11;
-                    break;
-
-                case 'C':
-                case'c':
-                    tempCharStorage = 12;
-                    break;
-
-                case 'D':
-                case'd':
-                    tempCharStorage = 13;
-                    break;
-
-                case 'E':
-                case'e':
-                    tempCharStorage = 14;
-                    break;
-
-                case 'F':
-                case 'f':
-                    tempCharStorage = 15;
-                    break;
-
-                default:
-                    tempCharStorage = 0;
-                    break;
-            }
+            tempCharStorage = hexToValue(tempCharStorage);
             userColor <<= 4; //shift 4 bits at a time
             userColor += tempCharStorage;
         }
         //reset usart buffer for next reading
         ResetUSARTBuffer();
         //set the user color
-        ledColorSet(userColor);
+        userColorSelected = TRUE;
+        if (zone < PWM_ZONES)
+        {
+            ledZoneSet(zone, userColor); //single zone, the stored color is not changed
+            PWMLatch();
+        }
+        else
+        {
+            ledColorSet(userColor);
+            ledColorSave();
+        }
     }
 }
 
 void main(void)
 {
     unsigned long randcolor = 0;		//reset the randomcolor variable
-    unsigned char SWDetails[10] = "";	//software details variable
     unsigned char prevSWVal = SWITCH_NOTPRESSED;	//no switches pressed
 
-    userColorSelected = FALSE;			//user not selected a color
-    userColor = 0;
     initHW(); 							//initialize the hardware
-    ledInit();							//initalize the led PWM
-    InitTimer1(); 						//initialize timer 1
-    USARTInit(9600); 					//set 9600 baud (cannot go faster on a 4Mhz clock)
+    PWMInit(); 							//initialize the PWM driver
+    ledInit();							//initalize the led PWM, user not selected a color
+
+    // restore the stored configuration and bring the light up before anything else (also after a brownout or watchdog reset)
+    ConfigLoad();						//the defaults are used if the block is not valid
+    if (config.flags & CFG_USER_COLOR)
+    {
+        userColorSelected = TRUE;
+        ledColorSet(((unsigned long) config.red << 16) | ((unsigned int) config.green << 8) | config.blue);
+    }
+    PWMEnable(ON);
+#ifdef SOUND_EN
+    SoundSetMode(config.soundMode, config.soundThreshold);
+#endif
+    USARTInit(config.baud);				//stored baud rate, 9600 baud if there is none (19200 is the fastest on a 4Mhz clock)
 
     USARTWriteConstString("# RGB LED");	//write text to USART. 
     USARTGotoNewLine();					
     USARTWriteConstString("HW Ver 1.2 & SW Ver 1.4");
     USARTGotoNewLine();
-    sprintf(SWDetails, "Build %s", __DATE__);
-    USARTWriteConstString(SWDetails);
-    sprintf(SWDetails, " %s", __TIME__);
-    USARTWriteConstString(SWDetails);
+    USARTWriteConstString("Build ");	//no sprintf(), it does not fit in the program memory
+    USARTWriteConstString(__DATE__);
+    USARTWriteConstChar(' ');
+    USARTWriteConstString(__TIME__);
     USARTGotoNewLine();
 
-    srand(TMR1L); 						//timer one low value will be used to seed the random number generator
+    srand(PWM_SEED_REG); 				//the PWM timer value will be used to seed the random number generator
 
     CLRWDT(); //kick the dog (only 2.4 seconds available until dog barks)
 
@@ -367,24 +523,15 @@ void main(void)
         __delay_ms(DEBOUNCE_VALUE); 	//debounce key press
         if ((RED_BTN == SWITCH_PRESSED) && (GRN_BTN == SWITCH_PRESSED) && (BLU_BTN == SWITCH_PRESSED)) //all three buttons pressed
         {
-            EEwrite(RED_ADDR, 0); //reset the red, green and blue duty cycle and write to EEPROM
-            EEwrite(GRN_ADDR, 0);
-            EEwrite(BLU_ADDR, 0);
+            ConfigDefaults(); //no user color, 9600 baud, sound off
+            ConfigSave(); //also clears a color left by the older software
             confirmOperation(5); //give 5 blinks to confirm erase of user color
         }
 
+        PWMEnable(OFF);
         for (;;); //wait for watchdog to reset
     }
 
-    // check EEPROM if user has a color set
-    PWM_RedDC = EEread(RED_ADDR);
-    PWM_GreenDC = EEread(GRN_ADDR);
-    PWM_BlueDC = EEread(BLU_ADDR);
-
-	// if any one color is NOT zero in the EEPROM then user has a stored color
-    if ((PWM_RedDC != 0) || (PWM_GreenDC != 0) || (PWM_BlueDC != 0))
-        userColorSelected = TRUE;
-
     while (1)
     {
         CLRWDT(); 		//kick the dog
@@ -408,9 +555,7 @@ void main(void)
             {
 				if (userColorSelected && (prevSWVal == SWITCH_NOTPRESSED)) //user selected a color
                 {
-                    EEwrite(RED_ADDR, PWM_RedDC); //save the red duty cycle
-                    EEwrite(GRN_ADDR, PWM_GreenDC); //save the green duty cycle
-                    EEwrite(BLU_ADDR, PWM_BlueDC); //save the blue duty cycle
+                    ledColorSave(); //save the color being displayed
                     prevSWVal = SWITCH_PRESSED; //switch is pressed
                     confirmOperation(3); //give three blinks to indicate user color mode saved
                 }
@@ -439,6 +584,7 @@ void main(void)
             {
                 if (PWM_RedDC++ == 100) //if PWM reaches 100% then bring it back to zero
                     PWM_RedDC = 0;
+                ledDutyUpdate();
             }
         }
         else if (GRN_BTN == SWITCH_PRESSED)
@@ -448,6 +594,7 @@ void main(void)
             {
                 if (PWM_GreenDC++ == 100) //if PWM reaches 100% then bring it back to zero
                     PWM_GreenDC = 0;
+                ledDutyUpdate();
             }
         }
         else if (BLU_BTN == SWITCH_PRESSED)
@@ -457,6 +604,7 @@ void main(void)
             {
                 if (PWM_BlueDC++ == 100) //if PWM reaches 100% then bring it back to zero
                     PWM_BlueDC = 0;
+                ledDutyUpdate();
             }
         }
 
@@ -16,6 +16,28 @@
 #ifndef XC_HEADER_TEMPLATE_H
 #define	XC_HEADER_TEMPLATE_H
 
+#if defined(_PIC14E)
+// PIC16F1827/1847 Configuration Bit Settings (hardware PWM on the CCP modules)
+
+// CONFIG1
+#pragma config FOSC = INTOSC    // Oscillator Selection (INTOSC oscillator: I/O function on CLKIN pin)
+#pragma config WDTE = ON        // Watchdog Timer Enable (WDT enabled)
+#pragma config PWRTE = ON       // Power-up Timer Enable (PWRT enabled)
+#pragma config MCLRE = ON       // MCLR Pin Function Select (MCLR/VPP pin function is MCLR)
+#pragma config CP = ON          // Flash Program Memory Code Protection (Program memory code protection is enabled)
+#pragma config CPD = OFF        // Data Memory Code Protection (Data memory code protection is disabled)
+#pragma config BOREN = ON       // Brown-out Reset Enable (Brown-out Reset enabled)
+#pragma config CLKOUTEN = OFF   // Clock Out Enable (CLKOUT function is disabled)
+#pragma config IESO = OFF       // Internal/External Switchover (Internal/External Switchover mode is disabled)
+#pragma config FCMEN = OFF      // Fail-Safe Clock Monitor Enable (Fail-Safe Clock Monitor is disabled)
+
+// CONFIG2
+#pragma config WRT = OFF        // Flash Memory Self-Write Protection (Write protection off)
+#pragma config PLLEN = ON       // PLL Enable (4x PLL enabled, 8Mhz internal oscillator gives 32Mhz)
+#pragma config STVREN = ON      // Stack Overflow/Underflow Reset Enable (Stack Overflow or Underflow will cause a Reset)
+#pragma config BORV = LO        // Brown-out Reset Voltage Selection (Brown-out Reset Voltage (Vbor), low trip point selected.)
+#pragma config LVP = OFF        // Low-Voltage Programming Enable (High-voltage on MCLR/VPP must be used for programming)
+#else
 // PIC16F628A Configuration Bit Settings
 
 // CONFIG
@@ -28,14 +50,20 @@
 #pragma config CPD = OFF        // Data Code Protection bit (Data memory code protection off)
 #pragma config CP = ON          // Code Protection bits (Program memory code protection on)
 
+#endif
+
 // #pragma config statements should precede project file includes.
 
 #include <xc.h> 				// include processor files - each processor file is guarded.
 #include <stdlib.h> 			// standard library functions
 #include <string.h>				// string functions
-#include <stdio.h>				// standard I/O functions
+#include "pwm.h"				// LED PWM driver
 
+#if defined(_PIC14E)
+#define _XTAL_FREQ (32000000UL)	//8Mhz internal clock with 4x PLL is being used
+#else
 #define _XTAL_FREQ (4000000UL)	//4Mhz internal clock is being used
+#endif
 
 #define TRUE    1
 #define FALSE   0
@@ -47,20 +75,15 @@
 #define SWITCH_NOTPRESSED 1 	//active high
 #define DEBOUNCE_VALUE 50  		//time in ms
 
-#define LedPinRed    RA7
-#define LedPinGreen  RA0
-#define LedPinBlue   RA1
-
 #define RED_BTN     RB3
 #define GRN_BTN     RB4
 #define BLU_BTN     RB5
 
-//eeprom addresses to store the RGB values
-#define RED_ADDR    0
-#define GRN_ADDR    1
-#define BLU_ADDR    2
+//map of the colors (RRGGBB) for the color list and the palette of the sound mode, X() is applied to every color
+#define LED_COLOR_MAP(X)    X(0xFF0000) X(0x00FF00) X(0x0000FF) X(0xFFFF00) X(0x00FFFF) X(0xFF00FF) X(0xFFFFFF) X(0x9400D3)
 
-void InitTimer1(void);
+//convert a 0~100 duty cycle to an 8 bit color value, rounded up so that map() gives the same duty cycle back
+#define LED_PCT_TO_COLOR(pct)   ((((unsigned int) (pct) * 255) + 99) / 100)
 
 #endif	/* XC_HEADER_TEMPLATE_H */
 
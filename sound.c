@@ -0,0 +1,96 @@
+/*--------------------------------------------------------------------------------------
+ SOUND.C - The file that contains the sound reactive mode.
+ Copyright (C) 2020 Jagannatha Rao (aka JagiChan) (jagannath_raous@yahoo.com)
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------------------------*/
+
+#include "rgbmain.h"
+#include "sound.h"
+
+#ifdef SOUND_EN
+
+// RRGGBB color to PWM driver levels, done at compile time
+#define SOUND_RGB(rgb)  {PWM_COLOR_TO_LEVEL(((rgb) >> 16) & 0xFF), PWM_COLOR_TO_LEVEL(((rgb) >> 8) & 0xFF), PWM_COLOR_TO_LEVEL((rgb) & 0xFF)},
+
+// palette for SOUND_STEP, the colors of the color map
+const unsigned int soundPalette[][3] = {LED_COLOR_MAP(SOUND_RGB)};	//red, green and blue only, see PWMLoadLevels()
+
+#define SOUND_PALETTE_SIZE  (sizeof (soundPalette) / sizeof (soundPalette[0]))
+
+unsigned char soundMode = SOUND_OFF;
+unsigned char soundPaletteIdx;
+unsigned char soundLastBeat;		// PWM period of the last beat
+
+// Set the sound mode and the comparator threshold (0~15, VREF = threshold/24 Vdd)
+void SoundSetMode(unsigned char mode, unsigned char threshold)
+{
+    CMIE = 0;
+
+    if ((mode == SOUND_OFF) || (mode >= SOUND_MODES))
+    {
+        soundMode = SOUND_OFF;
+        CMCON = 7; 			//disable the comparators
+        VRCON = 0x00;		//disable the voltage reference
+        return;
+    }
+
+    soundMode = mode;
+    soundPaletteIdx = 0;
+    soundLastBeat = pwmPeriods - SOUND_HOLDOFF;
+
+    //VREN = 1, VROE = 0 (RA2 stays an input), VRR = 1 (low range)
+    VRCON = 0xA0 | (threshold & 0x0F);
+
+    //CM = 010, four inputs multiplexed to two comparators, CIS = 1 selects RA3 (C1) and RA2 (C2)
+    //against VREF. Outputs inverted so that CxOUT = 1 when the envelope is above the threshold.
+    CMCON = 0b00111010;
+
+    __delay_us(10);			//comparator and reference settling time
+    (void) CMCON;			//end the mismatch condition
+    CMIF = 0;
+    CMIE = 1;
+    PEIE = 1;
+}
+
+// Comparator interrupt, called from the interrupt function
+void SoundHandleInt(void)
+{
+    unsigned char cmcon = CMCON;	//reading CMCON ends the mismatch condition
+
+    CMIF = 0;
+
+    //only a rising envelope is a beat, and not too soon after the last one
+    if (((cmcon & 0xC0) == 0) || ((unsigned char) (pwmPeriods - soundLastBeat) < SOUND_HOLDOFF))
+        return;
+
+    soundLastBeat = pwmPeriods;
+
+    switch (soundMode)
+    {
+        case SOUND_FLASH:
+            PWMBoost(PWM_MAX_DUTY, PWM_MAX_DUTY / 4); //full on, gone after 4 periods
+            break;
+
+        case SOUND_PULSE:
+            PWMBoost(PWM_MAX_DUTY / 2, PWM_MAX_DUTY / 50); //fades back in 25 periods
+            break;
+
+        case SOUND_STEP:
+            if (++soundPaletteIdx >= SOUND_PALETTE_SIZE)
+                soundPaletteIdx = 0;
+            PWMLoadLevels(soundPalette[soundPaletteIdx]);
+            break;
+
+        default:
+            break;
+    }
+}
+
+#endif
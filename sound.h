@@ -0,0 +1,44 @@
+/*--------------------------------------------------------------------------------------
+ SOUND.H - Header file for the sound reactive mode.
+ Copyright (C) 2020 Jagannatha Rao (aka JagiChan) (jagannath_raous@yahoo.com)
+
+ A microphone envelope detector is connected to the comparator inputs RA3 (C1) and RA2 (C2).
+ The internal voltage reference sets the threshold and every time the envelope rises above
+ it the comparator interrupt triggers a beat. No ADC is needed and the reaction happens
+ in the interrupt, within one PWM step of the beat.
+
+ Only available on the PIC16F628A (define SOUND_EN).
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------------------------*/
+
+#ifndef SOUND_H
+#define	SOUND_H
+
+#if defined(_PIC14E)
+#undef SOUND_EN		//the comparator front end is only implemented for the PIC16F628A
+#endif
+
+//sound modes
+#define SOUND_OFF       0	//comparators disabled
+#define SOUND_FLASH     1	//short full white flash on every beat
+#define SOUND_PULSE     2	//the color brightens on every beat and fades back
+#define SOUND_STEP      3	//step to the next color of the palette on every beat
+#define SOUND_MODES     4
+
+#define SOUND_DEF_THRESHOLD     6	//VREF = 6/24 Vdd
+#define SOUND_HOLDOFF           10	//PWM periods (~140 ms) before the next beat is accepted
+
+extern unsigned char soundMode;
+
+void SoundSetMode(unsigned char mode, unsigned char threshold);
+void SoundHandleInt(void);
+
+#endif	/* SOUND_H */
+
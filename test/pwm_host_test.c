@@ -0,0 +1,247 @@
+/*--------------------------------------------------------------------------------------
+ PWM_HOST_TEST.C - Host test of the LED PWM driver.
+ Copyright (C) 2020 Jagannatha Rao (aka JagiChan) (jagannath_raous@yahoo.com)
+
+ Built with a PC compiler, so pwm.c uses the host mock of the software PWM. The test
+ drives PWMTick() like the Timer 1 interrupt and reads the LED outputs from the port
+ shadows. Built once for every channel option (see the Makefile), run with make -C test.
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include "pwm.h"
+
+#if PWM_BACKEND != PWM_BACKEND_HOST
+#error "the test needs the host mock of the PWM driver"
+#endif
+
+#define CHECK(cond, ...)    {if (!(cond)) {printf("FAIL %s:%d: ", __func__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++;}}
+
+// duty cycles of the channels, with two channels sharing an edge, an off and a full on channel
+const unsigned char testDuty[7] = {5, 5, 60, 0, 100, 33, 99};
+
+unsigned int failures;
+
+// Output of a channel
+static unsigned char pinOn(unsigned char ch)
+{
+    return ((pwmPortA & pwmBitA[ch]) || (pwmPortB & pwmBitB[ch])) ? 1 : 0;
+}
+
+// Tick until a new period starts, the outputs then show step 0 of the period
+static void syncPeriod(void)
+{
+    unsigned char periods = pwmPeriods;
+
+    while (periods == pwmPeriods)
+        PWMTick();
+}
+
+// Run one period from step 0, count the steps every channel is on and the steps it was switched on again.
+// Ends at step 0 of the next period.
+static void runPeriod(unsigned int *on, unsigned int *glitch)
+{
+    unsigned char ch, prev[PWM_CHANNELS];
+
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+    {
+        on[ch] = 0;
+        prev[ch] = 1;
+    }
+
+    for (unsigned char step = 0; step < PWM_MAX_DUTY; step++)
+    {
+        for (ch = 0; ch < PWM_CHANNELS; ch++)
+        {
+            if (pinOn(ch))
+            {
+                on[ch]++;
+                if (!prev[ch] && glitch)
+                    glitch[ch]++; //an output may only switch off within a period
+            }
+            prev[ch] = pinOn(ch);
+        }
+        PWMTick();
+    }
+}
+
+// Set the test duty cycles on all the channels
+static void setTestDuty(void)
+{
+    for (unsigned char ch = 0; ch < PWM_CHANNELS; ch++)
+        PWMSetDuty(ch, testDuty[ch]);
+    PWMLatch();
+}
+
+// Every channel is on for its duty cycle at the start of the period, so the edges come in the order of the duty cycles
+static void testDutyAndEdges(void)
+{
+    unsigned int on[PWM_CHANNELS], glitch[PWM_CHANNELS] = {0};
+
+    setTestDuty();
+    syncPeriod();
+    for (unsigned char p = 0; p < 3; p++)
+    {
+        runPeriod(on, glitch);
+        for (unsigned char ch = 0; ch < PWM_CHANNELS; ch++)
+        {
+            CHECK(on[ch] == testDuty[ch], "channel %u on %u steps, expected %u", ch, on[ch], testDuty[ch]);
+            CHECK(glitch[ch] == 0, "channel %u switched on within the period", ch);
+        }
+    }
+}
+
+// New levels only take effect at the start of the next period
+static void testLatch(void)
+{
+    unsigned int on[PWM_CHANNELS];
+    unsigned char ch;
+
+    setTestDuty();
+    syncPeriod();
+    for (unsigned char step = 0; step < 3; step++)
+        PWMTick();
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+        PWMSetDuty(ch, 50);
+    PWMLatch();
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+        CHECK(pinOn(ch) == (testDuty[ch] > 3), "channel %u changed within the period", ch);
+
+    syncPeriod();
+    runPeriod(on, NULL);
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+        CHECK(on[ch] == 50, "channel %u on %u steps after the latch, expected 50", ch, on[ch]);
+}
+
+// The fraction of the level is dithered over the periods, 256 periods give the exact average
+static void testDither(void)
+{
+    const unsigned int level[7] = {(1 << 8) + 64, 1, 50 << 8, (99 << 8) + 128, 255, (20 << 8) + 1, PWM_MAX_LEVEL};
+    unsigned long total[PWM_CHANNELS] = {0};
+    unsigned int on[PWM_CHANNELS], glitch[PWM_CHANNELS] = {0};
+    unsigned char ch;
+
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+        PWMSetLevel(ch, level[ch]);
+    PWMLatch();
+    syncPeriod();
+    for (unsigned int p = 0; p < 256; p++)
+    {
+        runPeriod(on, glitch);
+        for (ch = 0; ch < PWM_CHANNELS; ch++)
+        {
+            total[ch] += on[ch];
+            CHECK((on[ch] == (level[ch] >> 8)) || (on[ch] == (level[ch] >> 8) + 1),
+                  "channel %u on %u steps, more than one step from the level", ch, on[ch]);
+        }
+    }
+
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+    {
+        CHECK(total[ch] == level[ch], "channel %u average %lu/256 steps, expected %u/256", ch, total[ch], level[ch]);
+        CHECK(glitch[ch] == 0, "channel %u switched on within the period", ch);
+    }
+}
+
+// The boost raises all the channels and drops by the decay every period
+static void testBoost(void)
+{
+    unsigned int on[PWM_CHANNELS];
+    unsigned int boost = 40;
+    unsigned int expect;
+
+    setTestDuty();
+    syncPeriod();
+    PWMBoost(40, 15);
+    syncPeriod();
+    for (unsigned char p = 0; p < 5; p++)
+    {
+        runPeriod(on, NULL);
+        for (unsigned char ch = 0; ch < PWM_CHANNELS; ch++)
+        {
+            expect = testDuty[ch] + boost;
+            if (expect > PWM_MAX_DUTY)
+                expect = PWM_MAX_DUTY;
+            CHECK(on[ch] == expect, "period %u channel %u on %u steps, expected %u", p, ch, on[ch], expect);
+        }
+        boost = (boost > 15) ? boost - 15 : 0;
+    }
+}
+
+// The RGB levels of every zone are replaced at the next period, the other channels keep their level
+static void testLoadLevels(void)
+{
+    const unsigned int rgb[3] = {10 << PWM_FRAC_BITS, 0, PWM_MAX_LEVEL};
+    unsigned int on[PWM_CHANNELS];
+    unsigned char ch, zone, expect[PWM_CHANNELS];
+
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+        PWMSetDuty(ch, 0);
+    PWMLatch();
+    syncPeriod();
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+    {
+        PWMSetDuty(ch, 50);
+        expect[ch] = 50;
+    }
+    PWMLatch(); //not picked up yet, the other channels get these levels with the loaded ones
+    for (zone = 0; zone < PWM_ZONES; zone++)
+    {
+        for (unsigned char i = 0; i < 3; i++)
+            expect[PWM_ZONE_CH(zone, i)] = rgb[i] >> PWM_FRAC_BITS;
+    }
+
+    PWMTick();
+    PWMLoadLevels(rgb);
+    PWMTick(); //the new period starts right away
+    runPeriod(on, NULL);
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+        CHECK(on[ch] == expect[ch], "channel %u on %u steps, expected %u", ch, on[ch], expect[ch]);
+
+    setTestDuty(); //a latch replaces the loaded levels
+    syncPeriod();
+    runPeriod(on, NULL);
+    for (ch = 0; ch < PWM_CHANNELS; ch++)
+        CHECK(on[ch] == testDuty[ch], "channel %u on %u steps after the latch, expected %u", ch, on[ch], testDuty[ch]);
+}
+
+// A stopped PWM drives all the outputs low and the ticks do nothing
+static void testDisable(void)
+{
+    unsigned char periods;
+
+    setTestDuty();
+    PWMEnable(0);
+    periods = pwmPeriods;
+    for (unsigned int t = 0; t < 3 * PWM_MAX_DUTY; t++)
+    {
+        PWMTick();
+        for (unsigned char ch = 0; ch < PWM_CHANNELS; ch++)
+            CHECK(!pinOn(ch), "channel %u on while stopped", ch);
+    }
+    CHECK(periods == pwmPeriods, "periods counted while stopped");
+    PWMEnable(1);
+}
+
+int main(void)
+{
+    PWMInit();
+    PWMEnable(1);
+
+    testDutyAndEdges();
+    testLatch();
+    testDither();
+    testBoost();
+    testLoadLevels();
+    testDisable();
+
+    printf("%u channels, %u zones: %s\n", PWM_CHANNELS, PWM_ZONES, failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
@@ -19,13 +19,46 @@
 #include "rgbmain.h"		//remove this header file if you plan to use XC.h directly
 #include "usart.h"
 
-//baudrate calculation macro (done at compile time, _XTAL_FREQ is defined in header file)
-#define SetBaudRate(baud_rate)   (SPBRG = (((_XTAL_FREQ/baud_rate)/16)-1))
-
-//Initialize the hardware USART
-void USARTInit(unsigned int baud_rate)
+struct Buffer buffer = {
+    {0}, 0, 0};
+
+//baudrate calculation macros (done at compile time, _XTAL_FREQ is defined in header file)
+#define USART_SPBRG(baud_rate)      (((_XTAL_FREQ + 8UL * (baud_rate)) / (16UL * (baud_rate))) - 1)	//BRGH = 1, rounded
+#define USART_ACTUAL(baud_rate)     (_XTAL_FREQ / (16UL * (USART_SPBRG(baud_rate) + 1)))
+#define USART_ERROR(baud_rate)      (((USART_ACTUAL(baud_rate) > (baud_rate)) ? \
+                                      (USART_ACTUAL(baud_rate) - (baud_rate)) : ((baud_rate) - USART_ACTUAL(baud_rate))) \
+                                      * 1000UL / (baud_rate))	//error in 1/1000
+#define USART_MAX_ERROR             25	//2.5%, half of what an 8N1 frame can take, the other half is for the other side
+#define USART_BAUD_OK(baud_rate)    ((USART_SPBRG(baud_rate) <= 255) && (USART_ERROR(baud_rate) <= USART_MAX_ERROR))
+
+#if !USART_BAUD_OK(9600) || !USART_BAUD_OK(19200)
+#error "baud rate out of tolerance for _XTAL_FREQ"
+#endif
+#if (USART_BAUD_COUNT > 2) && (!USART_BAUD_OK(38400) || !USART_BAUD_OK(57600) || !USART_BAUD_OK(115200))
+#error "baud rate out of tolerance for _XTAL_FREQ"
+#endif
+
+//baud rate table, same order as the USART_BAUD_xxx indexes
+const unsigned long usartBaudRate[USART_BAUD_COUNT] = {
+    9600, 19200
+#if USART_BAUD_COUNT > 2
+    , 38400, 57600, 115200
+#endif
+};
+
+const unsigned char usartSPBRG[USART_BAUD_COUNT] = {
+    USART_SPBRG(9600), USART_SPBRG(19200)
+#if USART_BAUD_COUNT > 2
+    , USART_SPBRG(38400), USART_SPBRG(57600), USART_SPBRG(115200)
+#endif
+};
+
+//Initialize the hardware USART, baud is one of the USART_BAUD_xxx indexes
+void USARTInit(unsigned char baud)
 {
-    SetBaudRate(baud_rate);
+    if (baud >= USART_BAUD_COUNT)
+        baud = USART_DEF_BAUD;
+    SPBRG = usartSPBRG[baud];
 
     //TXSTA
     CSRC = 0; //clock source don't care, async mode
@@ -47,6 +80,34 @@ void USARTInit(unsigned int baud_rate)
     PEIE = 1;
 }
 
+// Switch to another baud rate once everything written so far has been sent
+void USARTSetBaud(unsigned char baud)
+{
+    if (baud >= USART_BAUD_COUNT)
+        return;
+
+    while (!PIR1bits.TXIF); //wait for the last character to move to the shift register
+    while (!TRMT);			//and to leave it
+
+    SPBRG = usartSPBRG[baud];
+    CREN = 0; //drop anything received at the old rate, also clears an overrun error
+    CREN = 1;
+}
+
+// Get the table index of a baud rate, USART_BAUD_COUNT if it is not supported
+unsigned char USARTFindBaud(unsigned long baud_rate)
+{
+    unsigned char i;
+
+    for (i = 0; i < USART_BAUD_COUNT; i++)
+    {
+        if (usartBaudRate[i] == baud_rate)
+            break;
+    }
+
+    return i;
+}
+
 // write a constant char to serial port
 void USARTWriteConstChar(const unsigned char ch)
 {
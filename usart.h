@@ -19,11 +19,26 @@
 #ifndef USART_PIC16_18_H
 #define	USART_PIC16_18_H
 
+#ifndef _XTAL_FREQ
 #define _XTAL_FREQ (4000000UL)
+#endif
 
 //Constants
 #define BUFFER_SIZE  20
 
+//baud rates, index in the baud rate table (see usart.c)
+#define USART_BAUD_9600     0
+#define USART_BAUD_19200    1
+#if _XTAL_FREQ >= 32000000UL
+#define USART_BAUD_38400    2
+#define USART_BAUD_57600    3
+#define USART_BAUD_115200   4
+#define USART_BAUD_COUNT    5
+#else
+#define USART_BAUD_COUNT    2	//faster rates are out of tolerance on a 4Mhz clock
+#endif
+#define USART_DEF_BAUD      USART_BAUD_9600
+
 enum BufferStatus {
     BUFFER_OK, BUFFER_EMPTY, BUFFER_FULL
 };
@@ -34,10 +49,11 @@ struct Buffer {
     unsigned char read_index;
 };
 
-struct Buffer buffer = {
-    {0}, 0, 0};
+extern struct Buffer buffer;
 
-void USARTInit(unsigned int baud_rate);
+void USARTInit(unsigned char baud);
+void USARTSetBaud(unsigned char baud);
+unsigned char USARTFindBaud(unsigned long baud_rate);
 void USARTWriteChar(unsigned char ch);
 void USARTWriteConstChar(const unsigned char ch);
 void USARTWriteConstString(const unsigned char *str);